@@ -1,21 +1,48 @@
 #pragma once
+#include <chrono>
+#include <functional>
 #include <map>
+#include <set>
 #include <shared_mutex>
 
 #include <sisl/fds/buffer.hpp>
 #include <homedb/homedb_decls.h>
 
 namespace homedb {
+// Priority class of a DB or DBFamily. While waiting for admission, ops of a higher class (lower ordinal) are always
+// dispatched ahead of the lower class ones: in the family stage by the class of their DB and in the HomeDB wide stage
+// by the class of their family.
+ENUM(qos_class_t, uint8_t, CRITICAL, INTERACTIVE, BATCH)
+
+struct AdmissionOptions {
+    uint32_t max_inflight_ops{0};            // Max ops concurrently being served, 0 = unlimited
+    uint64_t max_ops_per_sec{0};             // Token bucket refill rate, 0 = no rate limit
+    uint32_t burst_ops{0};                   // Token bucket capacity, 0 = same as max_ops_per_sec
+    uint32_t max_queue_depth{1024};          // Ops waiting beyond this are rejected right away
+    std::chrono::milliseconds op_timeout{0}; // Default per-op deadline, 0 = no deadline
+
+    std::string to_string() const {
+        return fmt::format(
+            "max_inflight_ops={}, max_ops_per_sec={}, burst_ops={}, max_queue_depth={}, op_timeout_ms={}",
+            max_inflight_ops, max_ops_per_sec, burst_ops, max_queue_depth, op_timeout.count());
+    }
+};
+
 struct DBFamilyOptions {
     bool transaction_support{false};
     bool replication_on{false};
+    qos_class_t qos_class{qos_class_t::INTERACTIVE}; // Priority of this family ops against the other families
+    AdmissionOptions admission;                      // Limits shared by all the DBs of this family
 
     std::string to_string() false {
-        return fmt::format("transaction_support={}, replication_on={}", transaction_support, replication_on);
+        return fmt::format("transaction_support={}, replication_on={}, qos_class={}, admission=[{}]",
+                           transaction_support, replication_on, enum_name(qos_class), admission.to_string());
     }
 };
 
 class DB;
+struct DBOpts;
+class AdmissionController;
 class DBKey;
 class DBValue;
 class FQDBKey;
@@ -37,6 +64,8 @@ SCOPED_ENUM_DEF(Result, Status, uint16_t,
                 success,       // Success
                 key_not_found, // Search key or range not found
                 timeout,       // Operation timedout
+                not_supported, // Operation not supported with the current DBFamily options
+                failed,        // Operation failed in the underlying index
 )
 
 ENUM(put_type_t, uint8_t, INSERT, UPSERT, UPDATE)
@@ -59,11 +88,15 @@ struct db_family_super_blk {
 
 class DBFamily {
 public:
-    DBFamily(uuid_t dbf_uuid, const std::string& name, const DBFamilyOptions& opts);
-    DBFamily(const db_family_super_blk& sb);
+    // homedb_admission is the HomeDB wide admission stage shared by all the families
+    DBFamily(uuid_t dbf_uuid, const std::string& name, const DBFamilyOptions& opts,
+             shared< AdmissionController > homedb_admission);
+    DBFamily(const db_family_super_blk& sb, shared< AdmissionController > homedb_admission);
     void open(const DBFamilyOptions& opts);
 
-    shared< DB > create_db(const std::string& name, const DBOpts& db_opts);
+    // maker constructs DB subtypes (e.g. TypedDB), default is the dynamic blob based DB
+    using db_maker_t = std::function< shared< DB >(DBFamily*, const std::string&, const DBOpts&) >;
+    shared< DB > create_db(const std::string& name, const DBOpts& db_opts, const db_maker_t& maker = nullptr);
     shared< DB > open_db(const std::string& db_name, const DBOpts& db_opts);
     void load_db(const homestore::superblk< db_superblk >& db_sb);
     uuid_t uuid() const { return m_uuid; }
@@ -73,10 +106,21 @@ public:
     txn_id_t start_transaction();
     void commit_transaction(txn_id_t txn_id);
 
+    // A non-zero timeout overrides the op_timeout of the DB/DBFamily admission options. Ops which cannot be admitted
+    // before their deadline are completed with Result::Status::timeout.
     folly::Future< Result > put(cshared< DB >& db, put_type_t ptype, const sisl::blob& key, const sisl::blob& value,
-                                txn_id_t txn_id = invalid_txn);
+                                txn_id_t txn_id = invalid_txn,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
     folly::Future< Result > get(cshared< DB >& db, const sisl::blob& key, sisl::blob& out_value,
-                                txn_id_t txn_id = invalid_txn);
+                                txn_id_t txn_id = invalid_txn,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds{0});
+
+    AdmissionController& admission() { return *admission_; }
+
+    // Admission through the DB, family and HomeDB stages, for ops issued directly on a DB (e.g. TypedDB typed ops).
+    // Every admitted op has to be released once it completes.
+    folly::Future< bool > admit(cshared< DB >& db, std::chrono::milliseconds timeout);
+    void release(cshared< DB >& db);
 
 private:
     shared< DB > lookup_db(const std::string& db_name);
@@ -90,7 +134,10 @@ private:
 
     std::shared_mutex db_map_mtx_;
     std::map< std::string, DB > db_map_;
+    std::set< std::string > unloaded_db_names_; // DBs on disk which could not be loaded, their names stay reserved
     std::unique_ptr< sisl::SimpleHashMap< FQDBKey, bool > > txn_map_;
     std::atomic< uint64_t > cur_txn_id_{1};
+    shared< AdmissionController > admission_;
+    shared< AdmissionController > homedb_admission_;
 };
 } // namespace homedb
\ No newline at end of file
@@ -17,11 +17,15 @@ public:
     shared< DBFamily > create_db_family(uuid_t dbf_uuid, const std::string& name);
     shared< DBFamily > open_db_family(uuid_t dbf_uuid);
 
+    // Limits across all the families, families get admitted in the order of their qos_class
+    void set_admission_options(const AdmissionOptions& opts);
+
 private:
     std::map< uuid_t, shared< DBFamily > > db_families_;
     mutable std::shared_mutex family_mtx_;
     bool db_families_load_pending_{true};
     bool dbs_load_pending_{true};
+    shared< AdmissionController > admission_; // HomeDB wide admission stage, shared by all the families
 
 private:
     void init_meta_blks();
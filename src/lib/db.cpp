@@ -1,41 +1,93 @@
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
 #include <homedb/db_family.h>
 #include <homestore/homestore.hpp>
 #include <homestore/meta_service.hpp>
+#include "lib/db.h"
 
 using namespace homestore;
 
 namespace homedb {
+static std::mutex s_schema_mtx;
+static std::unordered_map< std::string, std::pair< std::type_index, db_loader_t > > s_schemas;
 
-DB::DB(DBFamily* db_family, std::string const& name, DBOpts const& opts) :
-        db_family_{db_family}, uuid_{boost::uuids::random_generator()()}, name_{name}, sb_{"DB"} {
+void register_db_schema(const std::string& schema_name, std::type_index db_type, db_loader_t loader) {
+    std::unique_lock lg{s_schema_mtx};
+    const auto [it, inserted] = s_schemas.try_emplace(schema_name, db_type, std::move(loader));
+    RELEASE_ASSERT(inserted || (it->second.first == db_type),
+                   "DB schema={} is already registered by a different type, recovery would open it with wrong ordering",
+                   schema_name);
+}
+
+db_loader_t find_db_schema(const std::string& schema_name) {
+    std::unique_lock lg{s_schema_mtx};
+    const auto it = s_schemas.find(schema_name);
+    return (it == s_schemas.cend()) ? nullptr : it->second.second;
+}
+
+Result::Status to_db_status(homestore::btree_status_t status) {
+    switch (status) {
+    case homestore::btree_status_t::success:
+        return Result::Status::success;
+    case homestore::btree_status_t::not_found:
+        return Result::Status::key_not_found;
+    case homestore::btree_status_t::not_supported:
+        return Result::Status::not_supported;
+    default:
+        return Result::Status::failed;
+    }
+}
+
+DB::DB(DBFamily* db_family, std::string const& name, DBOpts const& opts, DBSchema const& schema) :
+        db_family_{db_family},
+        uuid_{boost::uuids::random_generator()()},
+        name_{name},
+        sb_{"DB"},
+        fresh_create_{true},
+        admission_{std::make_shared< AdmissionController >(fmt::format("DB_{}.{}", db_family->name(), name),
+                                                           opts.admission)} {
     sb_.create(sizeof(db_super_blk));
     sb_->uuid = uuid_;
     std::memcpy(sb_->name, name.c_str(), std::min(name.c_str(), db_super_blk::MAX_NAME_LEN));
+    std::memset(sb_->schema_name, 0, db_super_blk::MAX_SCHEMA_NAME_LEN);
+    std::strncpy(sb_->schema_name, schema.name.c_str(), db_super_blk::MAX_SCHEMA_NAME_LEN - 1);
+    sb_->key_size = schema.key_size;
+    sb_->value_size = schema.value_size;
     sb_.write();
-    open(opts);
 
-    create_primary_index();
-    LOGINFO("DB={} uuid={} created and opened with opts={}", name_, uuid_, opts.to_string());
+    // Primary index is created on open, which the creator calls once the DB is fully constructed, so that TypedDB
+    // gets to create its own fixed size index
+    LOGINFO("DB={} uuid={} schema={} created", name_, uuid_, schema.is_typed() ? schema.name : "dynamic");
 }
 
 DB::DB(DBFamily* db_family, homestore::superblk< db_super_blk > const& sb) :
-        db_family_{db_family}, name_{sb->name}, uuid_{sb->uuid}, sb_{sb} {
+        db_family_{db_family},
+        name_{sb->name},
+        uuid_{sb->uuid},
+        sb_{sb},
+        admission_{std::make_shared< AdmissionController >(fmt::format("DB_{}.{}", db_family->name(), name_),
+                                                           AdmissionOptions{})} {
     LOGINFO("DB={} uuid={} loaded from superblk, yet to be opened", name_, uuid_);
 }
 
 void DB::open(const DBOpts& opts) {
     opts_ = opts;
+    admission_->reconfigure(opts.admission);
     LOGINFO("DB={} uuid={} opened with opts={}", name_, uuid_, opts.to_string());
 
-    if (primary_index_ == nullptr) {
-        LOGINFO("DB={} is opened, but it has not found the primary index, perhaps before index creation, system has "
-                "exited, recreating primary index",
-                name_);
+    if (!has_primary_index()) {
+        if (!fresh_create_) {
+            LOGINFO("DB={} is opened, but it has not found the primary index, perhaps before index creation, system "
+                    "has exited, recreating primary index",
+                    name_);
+        }
         create_primary_index();
     }
+    fresh_create_ = false;
 }
 
-shared< homestore::IndexTable< DBKey, DBValue > > DB::on_index_found(homestore::superblk< index_table_sb > const& sb) {
+shared< homestore::IndexTableBase > DB::on_index_found(homestore::superblk< index_table_sb > const& sb) {
     LOGINFO("DB={} uuid={} found an index={}", name_, uuid_, sb->uuid);
     auto* dbi_sb = r_cast< db_index_super_blk* >(sb->user_sb_bytes);
 
@@ -45,6 +97,7 @@ shared< homestore::IndexTable< DBKey, DBValue > > DB::on_index_found(homestore::
     } else {
         DEBUG_ASSERT(false, "Yet to support secondary index");
     }
+    return primary_index_;
 }
 
 void DB::create_primary_index() {
@@ -57,32 +110,46 @@ void DB::create_primary_index() {
     sb.write();
 }
 
-folly::Future< homestore::btree_status_t > DB::async_put(put_type_t ptype, sisl::blob const& key,
-                                                         sisl::blob const& value) {
-    if ((db_family_->opts().transaction_support) || (db_family_->opts().versioned_support) ||
-        (db_family_->opts().replication_on)) {
-        return folly::make_future< homestore::btree_status_t >(homestore::btree_status_t::not_supported);
-    } else {
-        db_req* req;
-        repl_dev_->async_alloc_write();
-        if (ptype == put_type_t::INSERT) {
-            bt_ptype = homestore::btree_put_type::INSERT;
-        } else if (ptype == put_type_t::UPSERT) {
-            bt_ptype = homestore::btree_put_type::UPSERT;
-        } else {
-            bt_ptype = homestore::btree_put_type::UPDATE;
-        }
-        return primary_index_->put(DBKey{key}, DBValue{value}, bt_ptype);
-    }
+bool DB::is_op_supported() const {
+    return !(db_family_->opts().transaction_support || db_family_->opts().replication_on);
 }
 
-folly::Future< btree_status_t > DB::get(const sisl::blob& key, sisl::blob& out_value) {
-    if ((db_family_->opts().transaction_support) || (db_family_->opts().replication_on)) {
-        return folly::make_future< btree_status_t >(btree_status_t::not_supported);
+homestore::btree_put_type DB::to_btree_put_type(put_type_t ptype) {
+    if (ptype == put_type_t::INSERT) {
+        return homestore::btree_put_type::INSERT;
+    } else if (ptype == put_type_t::UPSERT) {
+        return homestore::btree_put_type::UPSERT;
     } else {
-        auto req = std::make_shared< IndexGetRequest >(key, out_value);
-        return primary_index_->async_get(std::dynamic_pointer_cast< BtreeSingleGetRequest >(req));
+        return homestore::btree_put_type::UPDATE;
     }
 }
 
+folly::Future< Result > DB::put(put_type_t ptype, sisl::blob const& key, sisl::blob const& value) {
+    if (!is_op_supported()) { return folly::makeFuture(Result{Result::Status::not_supported, 0}); }
+
+    auto req = std::make_shared< IndexPutRequest >(key, value, to_btree_put_type(ptype));
+    return primary_index_->async_put(std::dynamic_pointer_cast< BtreeSinglePutRequest >(req))
+        .thenValue([req](btree_status_t status) { return Result{to_db_status(status), 0}; });
+}
+
+folly::Future< Result > DB::get(sisl::blob const& key, sisl::blob& out_value) {
+    if (!is_op_supported()) { return folly::makeFuture(Result{Result::Status::not_supported, 0}); }
+
+    auto req = std::make_shared< IndexGetRequest >(key, out_value);
+    return primary_index_->async_get(std::dynamic_pointer_cast< BtreeSingleGetRequest >(req))
+        .thenValue([req, &out_value](btree_status_t status) {
+            if (status != btree_status_t::success) { return Result{to_db_status(status), 0}; }
+
+            // Value is deserialized into the request, copy it out to the caller provided buffer
+            const sisl::blob val = req->m_value.serialize();
+            if (val.size > out_value.size) {
+                LOGERROR("DB get value size={} is larger than the out value size={}", val.size, out_value.size);
+                return Result{Result::Status::failed, 0};
+            }
+            std::memcpy(out_value.bytes, val.bytes, val.size);
+            out_value.size = val.size;
+            return Result{Result::Status::success, 0};
+        });
+}
+
 } // namespace homedb
\ No newline at end of file
@@ -1,25 +1,40 @@
 #pragma once
 
+#include <functional>
+#include <typeindex>
+#include <homedb/db_family.h>
 #include "lib/db_kv.h"
+#include "lib/db_admission.h"
 
 namespace homedb {
 struct DBOpts {
-    std::string to_string() const { return ""; }
+    qos_class_t qos_class{qos_class_t::INTERACTIVE}; // Priority of this DB ops against the other DBs of its family
+    AdmissionOptions admission;                      // Limits on this DB alone, on top of the family limits
+
+    std::string to_string() const {
+        return fmt::format("qos_class={}, admission=[{}]", enum_name(qos_class), admission.to_string());
+    }
 };
 
 #pragma pack(1)
 struct db_super_blk {
     static constexpr uint64_t MAGIC{0xDABAF00D};
-    static constexpr uint32_t VERSION{1};
+    static constexpr uint32_t VERSION{2}; // v2 added the typed schema fields, v1 superblks are dynamic DBs
+    static constexpr uint32_t TYPED_SCHEMA_VERSION{2};
     static constexpr size_t MAX_NAME_LEN{512};
+    static constexpr size_t MAX_SCHEMA_NAME_LEN{64};
 
     const uint64_t magic{MAGIC};
     const uint32_t version{VERSION};
     uuid_t uuid;
     char name[MAX_NAME_LEN];
+    char schema_name[MAX_SCHEMA_NAME_LEN]; // Empty for dynamic (blob) DBs, registered schema name for TypedDB
+    uint32_t key_size{0};                  // Fixed key size of TypedDB, 0 for dynamic DBs
+    uint32_t value_size{0};                // Fixed value size of TypedDB, 0 for dynamic DBs
 
     uint64_t get_magic() const { return magic; }
     uint32_t get_version() const { return version; }
+    bool is_typed() const { return (version >= TYPED_SCHEMA_VERSION) && (schema_name[0] != '\0'); }
 };
 
 struct db_index_super_blk {
@@ -52,28 +67,56 @@ public:
             m_value{value, false, /* copy */} {}
 };
 
-class DB {
+struct DBSchema {
+    std::string name; // Empty for dynamic (blob) DBs
+    uint32_t key_size{0};
+    uint32_t value_size{0};
+
+    bool is_typed() const { return !name.empty(); }
+};
+
+class DB;
+using db_loader_t = std::function< shared< DB >(DBFamily*, const homestore::superblk< db_super_blk >&) >;
+
+// Typed DBs have to register their schema before HomeDB is initialized, so that on recovery their DB superblk is
+// loaded into the TypedDB instance of the right key/value types. A schema name can be registered only by one type.
+void register_db_schema(const std::string& schema_name, std::type_index db_type, db_loader_t loader);
+db_loader_t find_db_schema(const std::string& schema_name);
+
+Result::Status to_db_status(homestore::btree_status_t status);
+
+class DB : public std::enable_shared_from_this< DB > {
 public:
-    DB(DBFamily*, const std::string& name, const DBOpts& opts);
+    DB(DBFamily*, const std::string& name, const DBOpts& opts, const DBSchema& schema = DBSchema{});
     DB(DBFamily*, const homestore::superblk< db_super_blk >& sb);
+    virtual ~DB() = default;
     void open(const DBOpts& opts);
 
     uuid_t uuid() const { return m_uuid; }
     std::string name() const { return m_name; }
+    qos_class_t qos_class() const { return opts_.qos_class; }
+    AdmissionController& admission() { return *admission_; }
 
-    folly::Future< Result > put(put_type_t ptype, sisl::blob const& key,  sisl::blob const& value);
-    folly::Future< Result > get( sisl::blob const& key, sisl::blob& out_value);
+    virtual folly::Future< Result > put(put_type_t ptype, sisl::blob const& key, sisl::blob const& value);
+    virtual folly::Future< Result > get(sisl::blob const& key, sisl::blob& out_value);
+    virtual shared< homestore::IndexTableBase >
+    on_index_found(homestore::superblk< homestore::index_table_sb > const& sb);
 
-private:
-    void create_primary_index();
+protected:
+    virtual void create_primary_index();
+    virtual bool has_primary_index() const { return (primary_index_ != nullptr); }
+    bool is_op_supported() const;
+    static homestore::btree_put_type to_btree_put_type(put_type_t ptype);
 
-private:
+protected:
     DBOpts opts_;
     DBFamily* db_family_; // Back pointer to parent db family
     std::string name_;
     uuid_t uuid_;
 
     homestore::superblk< db_super_blk > sb_;
+    bool fresh_create_{false}; // Created in this run, primary index is yet to be created on first open
     shared< homestore::IndexTable< DBKey, DBValue > > primary_index_;
+    shared< AdmissionController > admission_;
 };
 } // namespace homedb
\ No newline at end of file
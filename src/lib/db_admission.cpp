@@ -0,0 +1,235 @@
+#include <algorithm>
+#include <folly/executors/GlobalExecutor.h>
+#include <folly/futures/Future.h>
+
+#include "lib/db_admission.h"
+
+namespace homedb {
+static double bucket_capacity(const AdmissionOptions& opts) {
+    return s_cast< double >((opts.burst_ops != 0) ? opts.burst_ops : std::max(opts.max_ops_per_sec, uint64_t{1}));
+}
+
+AdmissionController::AdmissionController(const std::string& name, const AdmissionOptions& opts) :
+        name_{name},
+        opts_{opts},
+        metrics_{name},
+        executor_{folly::getGlobalCPUExecutor()},
+        tokens_{bucket_capacity(opts)},
+        last_refill_{Clock::now()} {}
+
+void AdmissionController::reconfigure(const AdmissionOptions& opts) {
+    {
+        std::unique_lock lg{mtx_};
+
+        // Account the tokens earned at the old rate first. A bucket which was not rate limited so far (including the
+        // default options a recovered DB/family starts with) starts full, rather than with its leftover token.
+        const auto now = Clock::now();
+        refill_tokens(now);
+        const bool was_rate_limited = (opts_.max_ops_per_sec != 0);
+        opts_ = opts;
+        tokens_ = was_rate_limited ? std::min(tokens_, bucket_capacity(opts_)) : bucket_capacity(opts_);
+        last_refill_ = now;
+    }
+    LOGINFO("Admission={} reconfigured with opts={}", name_, opts.to_string());
+
+    // Limits could have been relaxed, let the waiters in if possible
+    dispatch();
+}
+
+AdmissionController::Clock::time_point AdmissionController::deadline_for(std::chrono::milliseconds timeout) const {
+    if (timeout.count() == 0) {
+        std::unique_lock lg{mtx_};
+        timeout = opts_.op_timeout;
+    }
+    return (timeout.count() == 0) ? Clock::time_point::max() : Clock::now() + timeout;
+}
+
+folly::Future< bool > AdmissionController::admit(qos_class_t cls, Clock::time_point deadline) {
+    const auto now = Clock::now();
+    folly::Future< bool > f = folly::makeFuture(false);
+    bool arm_refill_timer{false};
+    Clock::duration refill_wait{0};
+    {
+        std::unique_lock lg{mtx_};
+        refill_tokens(now);
+
+        const uint32_t ahead = waiters_ahead(cls);
+        if ((ahead == 0) && can_admit()) {
+            take_slot();
+            COUNTER_INCREMENT(metrics_, admission_admitted_ops, 1);
+            GAUGE_UPDATE(metrics_, admission_inflight_ops, n_inflight_);
+            return folly::makeFuture(true);
+        }
+
+        // Fail fast, rather than queueing an op which we already know cannot make it in time
+        if (n_waiters_ >= opts_.max_queue_depth) {
+            COUNTER_INCREMENT(metrics_, admission_rejected_queue_full, 1);
+            return f;
+        }
+        if ((deadline <= now) || (token_wait(ahead) > (deadline - now))) {
+            COUNTER_INCREMENT(metrics_, admission_rejected_deadline, 1);
+            return f;
+        }
+
+        auto& q = waiters_[s_cast< size_t >(cls)];
+        q.push_back(Waiter{deadline, now, folly::Promise< bool >{}});
+        f = q.back().promise.getFuture();
+        ++n_waiters_;
+        next_expiry_ = std::min(next_expiry_, deadline);
+        COUNTER_INCREMENT(metrics_, admission_queued_ops, 1);
+        GAUGE_UPDATE(metrics_, admission_queue_depth, n_waiters_);
+
+        // If only the rate limiter is holding us back, no release() is going to wake us up, so arm a timer for the
+        // next token instead.
+        if (((opts_.max_inflight_ops == 0) || (n_inflight_ < opts_.max_inflight_ops)) && !refill_timer_armed_) {
+            refill_timer_armed_ = true;
+            arm_refill_timer = true;
+            refill_wait = token_wait(0);
+        }
+    }
+
+    if (arm_refill_timer) { schedule_dispatch(refill_wait, true /* refill_timer */); }
+    if (deadline != Clock::time_point::max()) { schedule_dispatch(deadline - now, false /* refill_timer */); }
+    return f;
+}
+
+void AdmissionController::release(bool refund_token) {
+    bool has_waiters;
+    {
+        std::unique_lock lg{mtx_};
+        DEBUG_ASSERT_GT(n_inflight_, 0, "Admission release without a matching admit");
+        --n_inflight_;
+        if (refund_token && (opts_.max_ops_per_sec != 0)) {
+            refill_tokens(Clock::now());
+            tokens_ = std::min(bucket_capacity(opts_), tokens_ + 1.0);
+        }
+        GAUGE_UPDATE(metrics_, admission_inflight_ops, n_inflight_);
+        has_waiters = (n_waiters_ > 0);
+    }
+    if (has_waiters) { dispatch(); }
+}
+
+uint32_t AdmissionController::queue_depth() const {
+    std::unique_lock lg{mtx_};
+    return n_waiters_;
+}
+
+uint32_t AdmissionController::inflight_ops() const {
+    std::unique_lock lg{mtx_};
+    return n_inflight_;
+}
+
+void AdmissionController::dispatch(bool from_refill_timer) {
+    std::vector< folly::Promise< bool > > expired;
+    std::vector< folly::Promise< bool > > admitted;
+    bool arm_refill_timer{false};
+    Clock::duration refill_wait{0};
+    {
+        std::unique_lock lg{mtx_};
+        const auto now = Clock::now();
+        refill_tokens(now);
+        if (now >= next_expiry_) { expire_waiters(now, expired); }
+
+        // Strict priority: a lower class is served only after all the higher class waiters are admitted
+        for (auto& q : waiters_) {
+            while (!q.empty() && can_admit()) {
+                take_slot();
+                HISTOGRAM_OBSERVE(metrics_, admission_queue_wait_latency_us,
+                                  std::chrono::duration_cast< std::chrono::microseconds >(now - q.front().enqueue_time)
+                                      .count());
+                admitted.push_back(std::move(q.front().promise));
+                q.pop_front();
+                --n_waiters_;
+            }
+        }
+        if (n_waiters_ == 0) { next_expiry_ = Clock::time_point::max(); }
+
+        // Only the refill timer itself disarms, so that releases and deadline timers don't pile up more timers
+        if (from_refill_timer) { refill_timer_armed_ = false; }
+        if ((n_waiters_ > 0) && !refill_timer_armed_ &&
+            ((opts_.max_inflight_ops == 0) || (n_inflight_ < opts_.max_inflight_ops))) {
+            refill_timer_armed_ = true;
+            arm_refill_timer = true;
+            refill_wait = token_wait(0);
+        }
+
+        COUNTER_INCREMENT(metrics_, admission_admitted_ops, admitted.size());
+        GAUGE_UPDATE(metrics_, admission_queue_depth, n_waiters_);
+        GAUGE_UPDATE(metrics_, admission_inflight_ops, n_inflight_);
+    }
+
+    if (arm_refill_timer) { schedule_dispatch(refill_wait, true /* refill_timer */); }
+
+    // Continuations of the waiters run the op itself, so resume them on the executor. Running them inline would run
+    // index ops on the timer thread, or recurse release() -> dispatch() -> op -> release() for ops which complete
+    // synchronously.
+    if (!expired.empty() || !admitted.empty()) {
+        executor_->add([expired = std::move(expired), admitted = std::move(admitted)]() mutable {
+            for (auto& p : expired) {
+                p.setValue(false);
+            }
+            for (auto& p : admitted) {
+                p.setValue(true);
+            }
+        });
+    }
+}
+
+void AdmissionController::expire_waiters(Clock::time_point now, std::vector< folly::Promise< bool > >& expired) {
+    next_expiry_ = Clock::time_point::max();
+    for (auto& q : waiters_) {
+        for (auto it = q.begin(); it != q.end();) {
+            if (it->deadline <= now) {
+                expired.push_back(std::move(it->promise));
+                it = q.erase(it);
+                --n_waiters_;
+            } else {
+                next_expiry_ = std::min(next_expiry_, it->deadline);
+                ++it;
+            }
+        }
+    }
+    COUNTER_INCREMENT(metrics_, admission_timedout_in_queue, expired.size());
+}
+
+void AdmissionController::schedule_dispatch(Clock::duration after, bool refill_timer) {
+    folly::futures::sleep(std::chrono::ceil< std::chrono::milliseconds >(after))
+        .toUnsafeFuture()
+        .thenValue([weak_ctrl = weak_from_this(), refill_timer](auto&&) {
+            if (auto ctrl = weak_ctrl.lock()) { ctrl->dispatch(refill_timer); }
+        });
+}
+
+void AdmissionController::refill_tokens(Clock::time_point now) {
+    if (opts_.max_ops_per_sec == 0) { return; }
+    const std::chrono::duration< double > elapsed = now - last_refill_;
+    tokens_ = std::min(bucket_capacity(opts_), tokens_ + (elapsed.count() * s_cast< double >(opts_.max_ops_per_sec)));
+    last_refill_ = now;
+}
+
+bool AdmissionController::can_admit() const {
+    if ((opts_.max_inflight_ops != 0) && (n_inflight_ >= opts_.max_inflight_ops)) { return false; }
+    return (opts_.max_ops_per_sec == 0) || (tokens_ >= 1.0);
+}
+
+void AdmissionController::take_slot() {
+    ++n_inflight_;
+    if (opts_.max_ops_per_sec != 0) { tokens_ -= 1.0; }
+}
+
+AdmissionController::Clock::duration AdmissionController::token_wait(uint32_t ahead) const {
+    if (opts_.max_ops_per_sec == 0) { return Clock::duration::zero(); }
+    const double deficit = s_cast< double >(ahead) + 1.0 - tokens_;
+    if (deficit <= 0) { return Clock::duration::zero(); }
+    return std::chrono::duration_cast< Clock::duration >(
+        std::chrono::duration< double >(deficit / s_cast< double >(opts_.max_ops_per_sec)));
+}
+
+uint32_t AdmissionController::waiters_ahead(qos_class_t cls) const {
+    uint32_t ahead{0};
+    for (size_t c{0}; c <= s_cast< size_t >(cls); ++c) {
+        ahead += waiters_[c].size();
+    }
+    return ahead;
+}
+} // namespace homedb
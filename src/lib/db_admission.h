@@ -0,0 +1,89 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+#include <folly/Executor.h>
+#include <folly/futures/Future.h>
+#include <sisl/metrics/metrics.hpp>
+#include <homedb/db_family.h>
+
+namespace homedb {
+class AdmissionMetrics : public sisl::MetricsGroup {
+public:
+    explicit AdmissionMetrics(const std::string& name) : sisl::MetricsGroup("Admission", name) {
+        REGISTER_COUNTER(admission_admitted_ops, "Ops admitted");
+        REGISTER_COUNTER(admission_queued_ops, "Ops which had to wait in the admission queue");
+        REGISTER_COUNTER(admission_rejected_queue_full, "Ops rejected as the admission queue was full");
+        REGISTER_COUNTER(admission_rejected_deadline, "Ops rejected as they cannot be admitted before deadline");
+        REGISTER_COUNTER(admission_timedout_in_queue, "Ops whose deadline expired while waiting in queue");
+        REGISTER_GAUGE(admission_queue_depth, "Ops waiting in the admission queue");
+        REGISTER_GAUGE(admission_inflight_ops, "Ops admitted and not yet completed");
+        REGISTER_HISTOGRAM(admission_queue_wait_latency_us, "Time spent by an op waiting to be admitted");
+
+        register_me_to_farm();
+    }
+
+    AdmissionMetrics(const AdmissionMetrics&) = delete;
+    AdmissionMetrics& operator=(const AdmissionMetrics&) = delete;
+    ~AdmissionMetrics() { deregister_me_from_farm(); }
+};
+
+// Admission control for ops of a DBFamily or a DB. An op is admitted when there is room under max_inflight_ops and a
+// token is available in the rate limiter bucket, otherwise it waits in a per qos_class queue. Ops which are not
+// expected to be admitted before their deadline are rejected right away instead of being queued.
+class AdmissionController : public std::enable_shared_from_this< AdmissionController > {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    AdmissionController(const std::string& name, const AdmissionOptions& opts);
+    void reconfigure(const AdmissionOptions& opts);
+
+    // Future is fulfilled with true once admitted (caller must call release() after the op completes) or with false
+    // if the op could not be admitted before the deadline.
+    folly::Future< bool > admit(qos_class_t cls, Clock::time_point deadline);
+
+    // refund_token returns the rate limiter token as well, for an admitted op which was never served
+    void release(bool refund_token = false);
+
+    Clock::time_point deadline_for(std::chrono::milliseconds timeout) const;
+    uint32_t queue_depth() const;
+    uint32_t inflight_ops() const;
+
+private:
+    struct Waiter {
+        Clock::time_point deadline;
+        Clock::time_point enqueue_time;
+        folly::Promise< bool > promise;
+    };
+
+    static constexpr size_t num_classes{3};
+
+    void refill_tokens(Clock::time_point now);
+    bool can_admit() const;
+    void take_slot();
+    Clock::duration token_wait(uint32_t ahead) const;
+    uint32_t waiters_ahead(qos_class_t cls) const;
+    void dispatch(bool from_refill_timer = false);
+    void expire_waiters(Clock::time_point now, std::vector< folly::Promise< bool > >& expired);
+    void schedule_dispatch(Clock::duration after, bool refill_timer);
+
+private:
+    std::string name_;
+    AdmissionOptions opts_;
+    AdmissionMetrics metrics_;
+    folly::Executor::KeepAlive<> executor_; // Admitted/expired waiters are resumed here, never inline
+
+    mutable std::mutex mtx_;
+    std::array< std::deque< Waiter >, num_classes > waiters_;
+    uint32_t n_waiters_{0};
+    uint32_t n_inflight_{0};
+    double tokens_{0};
+    Clock::time_point last_refill_;
+    Clock::time_point next_expiry_{Clock::time_point::max()}; // Earliest deadline among the waiters
+    bool refill_timer_armed_{false}; // Only one refill timer is pending at any time
+};
+} // namespace homedb
@@ -1,11 +1,18 @@
 #include <homedb/db_family.h>
 #include <homestore/homestore.hpp>
 #include <homestore/meta_service.hpp>
+#include "lib/db.h"
+#include "lib/db_admission.h"
 
 namespace homedb {
 
-DBFamily::DBFamily(const std::string& name, const DBFamilyOptions& opts) :
-        m_uuid{boost::uuids::random_generator()()}, m_name{name}, m_sb{"DBFamily"} {
+DBFamily::DBFamily(const std::string& name, const DBFamilyOptions& opts,
+                   shared< AdmissionController > homedb_admission) :
+        m_uuid{boost::uuids::random_generator()()},
+        m_name{name},
+        m_sb{"DBFamily"},
+        admission_{std::make_shared< AdmissionController >("DBFamily_" + name, opts.admission)},
+        homedb_admission_{std::move(homedb_admission)} {
     m_sb.create(sizeof(db_family_super_blk));
     m_sb->uuid = m_uuid;
     std::memcpy(m_sb->name, name.c_str(), std::min(name.c_str(), db_family_super_blk::MAX_NAME_LEN));
@@ -15,34 +22,52 @@ DBFamily::DBFamily(const std::string& name, const DBFamilyOptions& opts) :
     LOGINFO("DBFamily={} uuid={} created and opened with opts={}", m_name, m_uuid, opts.to_string());
 }
 
-DBFamily::DBFamily(const homestore::superblk< db_family_super_blk >& sb) :
-        m_name{sb->name}, m_uuid{sb->uuid}, m_sb{sb} {
+DBFamily::DBFamily(const homestore::superblk< db_family_super_blk >& sb,
+                   shared< AdmissionController > homedb_admission) :
+        m_name{sb->name},
+        m_uuid{sb->uuid},
+        m_sb{sb},
+        admission_{std::make_shared< AdmissionController >("DBFamily_" + m_name, AdmissionOptions{})},
+        homedb_admission_{std::move(homedb_admission)} {
     LOGINFO("DBFamily={} uuid={} loaded from superblk, yet to be opened", m_name, m_uuid);
 }
 
 void DBFamily::open(const DBFamilyOptions& opts) {
     m_opts = opts;
+    admission_->reconfigure(opts.admission);
     LOGINFO("DBFamily={} uuid={} opened with opts={}", m_name, m_uuid, opts.to_string());
 }
 
-shared< DB > DBFamily::create_db(const std::string& db_name, const DBOpts& db_opts) {
-    shared< DB > db;
-    do {
-        db = lookup_db(db_name);
-        if (db != nullptr) { break; }
-
-        db = std::make_shared< DB >(this, db_name, db_opts);
-        bool inserted;
-        {
-            std::unique_lock m_db_map_mtx;
-            inserted = m_db_map.insert(db->uuid(), db);
-        }
-    } while (!inserted);
+shared< DB > DBFamily::create_db(const std::string& db_name, const DBOpts& db_opts, const db_maker_t& maker) {
+    // DB is created and opened under the map lock, so that it is published only after its primary index is created
+    // and a racing create of the same name does not leave behind a half created DB.
+    std::unique_lock lg{m_db_map_mtx};
+    for (auto& db : m_db_map) {
+        if (db->name() == db_name) { return db; }
+    }
+    if (unloaded_db_names_.count(db_name) != 0) {
+        LOGERROR("DB of name={} exists on disk in DBFamily={}, but could not be loaded, cannot create it again",
+                 db_name, name());
+        return nullptr;
+    }
 
+    auto db = maker ? maker(this, db_name, db_opts) : std::make_shared< DB >(this, db_name, db_opts);
+    if (db == nullptr) { return nullptr; }
+    db->open(db_opts);
+    m_db_map.insert(db->uuid(), db);
     return db;
 }
 
 shared< DB > DBFamily::open_db(const std::string& db_name, const DBOpts& db_opts) {
+    {
+        std::shared_lock lg{m_db_map_mtx};
+        if (unloaded_db_names_.count(db_name) != 0) {
+            LOGERROR("DB of name={} in DBFamily={} could not be loaded during recovery, cannot open it", db_name,
+                     name());
+            return nullptr;
+        }
+    }
+
     shared< DB > db = lookup_db(db_name);
     if (db == nullptr) {
         LOGERROR("DB of name={} does not exists in DBFamily={}, has it been created earlier?", db_name, name());
@@ -62,7 +87,26 @@ void DBFamily::load_db(const homestore::superblk< db_superblk >& db_sb) {
         return;
     }
 
-    auto db = std::make_shared< DB >(this, db_sb);
+    shared< DB > db;
+    if (!db_sb->is_typed()) {
+        db = std::make_shared< DB >(this, db_sb);
+    } else {
+        const auto loader = find_db_schema(db_sb->schema_name);
+        if (loader == nullptr) {
+            LOGERROR("DB={} has typed schema={} which is not registered, register it before HomeDB init",
+                     db_sb->name, db_sb->schema_name);
+            DEBUG_ASSERT(false, "Unregistered DB schema");
+            unloaded_db_names_.insert(db_sb->name);
+            return;
+        }
+        db = loader(this, db_sb);
+        if (db == nullptr) {
+            // Superblk and index stay on disk, so reserve the name to avoid creating another DB by the same name
+            LOGERROR("DB={} could not be loaded with schema={}, skipping it", db_sb->name, db_sb->schema_name);
+            unloaded_db_names_.insert(db_sb->name);
+            return;
+        }
+    }
     m_db_map.insert(db->uuid(), db);
 }
 
@@ -76,11 +120,60 @@ shared< DB > DBFamily::lookup_db(const std::string& name) {
 
 txn_id_t DBFamily::start_transaction() { return m_cur_txn_id.fetch_add(1, std::memory_order_relaxed); }
 
+folly::Future< bool > DBFamily::admit(cshared< DB >& db, std::chrono::milliseconds timeout) {
+    const auto deadline =
+        std::min({db->admission().deadline_for(timeout), admission_->deadline_for(timeout),
+                  homedb_admission_->deadline_for(timeout)});
+
+    // Stages go from the narrowest to the widest, so that a DB or family over its own limits does not hold the slots
+    // of the wider stage. Within the family, DBs are ordered by their qos_class and across families by the family's.
+    return db->admission().admit(db->qos_class(), deadline).thenValue([this, db, deadline](bool admitted) {
+        if (!admitted) { return folly::makeFuture(false); }
+        return admission_->admit(db->qos_class(), deadline).thenValue([this, db, deadline](bool admitted) {
+            if (!admitted) {
+                // Op is never served, give the DB back its rate limiter token along with the slot
+                db->admission().release(true /* refund_token */);
+                return folly::makeFuture(false);
+            }
+            return homedb_admission_->admit(m_opts.qos_class, deadline).thenValue([this, db](bool admitted) {
+                if (!admitted) {
+                    admission_->release(true /* refund_token */);
+                    db->admission().release(true /* refund_token */);
+                }
+                return admitted;
+            });
+        });
+    });
+}
+
+void DBFamily::release(cshared< DB >& db) {
+    homedb_admission_->release();
+    admission_->release();
+    db->admission().release();
+}
+
 folly::Future< Result > DBFamily::put(cshared< DB >& db, put_type_t ptype, const sisl::blob& key,
-                                      const sisl::blob& value, txn_id_t txn_id_in) {
-    txn_id = txn_id_in;
-    if (m_opts.transaction_support && (txn_id_in == invalid_txn)) { txn_id = start_transaction(); }
+                                      const sisl::blob& value, txn_id_t txn_id_in, std::chrono::milliseconds timeout) {
+    return admit(db, timeout).thenValue([this, db, ptype, key, value, txn_id_in](bool admitted) {
+        if (!admitted) { return folly::makeFuture(Result{Result::Status::timeout, 0, txn_id_in}); }
+
+        txn_id_t txn_id = txn_id_in;
+        if (m_opts.transaction_support && (txn_id_in == invalid_txn)) { txn_id = start_transaction(); }
+
+        return db->put(ptype, key, value)
+            .thenValue([this, txn_id, txn_id_in](Result res) {
+                if (m_opts.transaction_support && (txn_id_in == invalid_txn)) { commit_transaction(txn_id); }
+                return res;
+            })
+            .ensure([this, db]() { release(db); });
+    });
+}
 
-    if (m_opts.transaction_support && (txn_id_in == invalid_txn)) { commit_transaction(txn_id); }
+folly::Future< Result > DBFamily::get(cshared< DB >& db, const sisl::blob& key, sisl::blob& out_value,
+                                      txn_id_t txn_id, std::chrono::milliseconds timeout) {
+    return admit(db, timeout).thenValue([this, db, key, &out_value, txn_id](bool admitted) {
+        if (!admitted) { return folly::makeFuture(Result{Result::Status::timeout, 0, txn_id}); }
+        return db->get(key, out_value).ensure([this, db]() { release(db); });
+    });
 }
 } // namespace homedb
\ No newline at end of file
@@ -1,9 +1,11 @@
 #include <homedb/homedb.h>
 #include <boost/uuid/uuid_generators.hpp>
 #include <boost/uuid/uuid_io.hpp>
+#include "lib/db_admission.h"
 
 namespace homedb {
-void HomeDB(const homestore::hs_input_params& params) : m_cfg{params} {
+void HomeDB(const homestore::hs_input_params& params) :
+        m_cfg{params}, admission_{std::make_shared< AdmissionController >("HomeDB", AdmissionOptions{})} {
     sisl::MallocMetrics::enable();
 
     HomeStore::instance()
@@ -41,7 +43,7 @@ shared< DBFamily > HomeDB::create_db_family(const std::string& name, const DBFam
         }
     }
 
-    auto dbf = std::make_shared< DBFamily >(name, opts);
+    auto dbf = std::make_shared< DBFamily >(name, opts, admission_);
     m_db_families.insert(std::make_pair(dbf->uuid(), dbf));
     return dbf;
 }
@@ -60,6 +62,8 @@ shared< DBFamily > HomeDB::open_db_family(const std::string& name, const DBFamil
     return nullptr;
 }
 
+void HomeDB::set_admission_options(const AdmissionOptions& opts) { admission_->reconfigure(opts); }
+
 void HomeDB::init_meta_blks() {
     homestore::meta_service().register_handler(
         "DBFamily",
@@ -89,7 +93,7 @@ void HomeDB::dbfamily_super_blk_found(const sisl::byte_view& buf, void* meta_coo
             return;
         }
 
-        auto dbf = std::make_shared< DBFamily >(dbf_sb);
+        auto dbf = std::make_shared< DBFamily >(dbf_sb, admission_);
         m_db_families.insert(dbf->uuid(), dbf);
     }
 }
@@ -98,7 +102,7 @@ void HomeDB::db_super_blk_found(const sisl::byte_view& buf, void* meta_cookie) {
     homestore::superblk< db_superblk > db_sb;
     db_sb.load(buf, meta_cookie);
     DEBUG_ASSERT_EQ(db_sb->get_magic(), db_superblk::MAGIC, "Invalid db metablk, magic mismatch");
-    DEBUG_ASSERT_EQ(db_sb->get_version(), db_superblk::VERSION, "Invalid version of db metablk");
+    DEBUG_ASSERT_LE(db_sb->get_version(), db_superblk::VERSION, "Invalid version of db metablk");
 
     // Find db family corresponding to this DB
     if (m_db_families_load_pending) {
@@ -116,7 +120,7 @@ void HomeDB::db_super_blk_found(const sisl::byte_view& buf, void* meta_cookie) {
     dbf->load_db(db_sb);
 }
 
-shared< homestore::IndexTable< DBKey, DBValue > >
+shared< homestore::IndexTableBase >
 HomeDB::index_super_blk_found(const homestore::superblk< homestore::index_table_sb >& index_sb) {
     uuid_t db_uuid = index_sb->m_parent_uuid;
 
@@ -132,7 +136,7 @@ HomeDB::index_super_blk_found(const homestore::superblk< homestore::index_table_
 
     // Try to find if the uuid of this belongs to any specific DBFamily.
     std::shared_lock lg{m_family_mtx};
-    shared< homestore::IndexTable< DBKey, DBValue > > index{nullptr};
+    shared< homestore::IndexTableBase > index{nullptr};
     for (auto& dbf : m_db_families) {
         auto db = dbf->find_db(db_uuid);
         if (db != nullptr) {
@@ -0,0 +1,207 @@
+#pragma once
+
+#include "lib/db.h"
+#include "lib/typed_db_kv.h"
+
+namespace homedb {
+// DB with compile time schema of trivially copyable key and value types. Unlike the dynamic DB, the primary index is
+// instantiated on the fixed size key/value types with FIXED btree node layout, so that keys and values are stored
+// without any per entry size overhead and comparisons are resolved at compile time.
+//
+// Usage:
+//     using MyDB = TypedDB< my_key_t, uint64_t >;
+//     MyDB::register_schema("my_db_schema"); // Before HomeDB init, so that recovery can instantiate MyDB
+//     auto db = MyDB::create(*db_family, "my_db", DBOpts{});
+template < typename KeyT, typename ValueT, typename Compare = std::less< KeyT > >
+class TypedDB : public DB {
+public:
+    using key_type = FixedDBKey< KeyT, Compare >;
+    using value_type = FixedDBValue< ValueT >;
+    using index_type = homestore::IndexTable< key_type, value_type >;
+
+    struct PutRequest : public homestore::BtreeSinglePutRequest {
+    public:
+        const key_type m_key;
+        const value_type m_value;
+
+    public:
+        PutRequest(KeyT const& key, ValueT const& value, homestore::btree_put_type ptype) :
+                homestore::BtreeSinglePutRequest(&m_key, &m_value, ptype), m_key{key}, m_value{value} {}
+    };
+
+    struct GetRequest : public homestore::BtreeSingleGetRequest {
+    public:
+        const key_type m_key;
+        value_type m_value;
+
+    public:
+        GetRequest(KeyT const& key) : homestore::BtreeSingleGetRequest(&m_key, &m_value), m_key{key} {}
+    };
+
+public:
+    TypedDB(DBFamily* db_family, const std::string& name, const DBOpts& opts) :
+            DB(db_family, name, opts, DBSchema{s_schema_name, sizeof(KeyT), sizeof(ValueT)}) {
+        // An empty schema would be persisted as a dynamic DB and recovered with the wrong index layout
+        RELEASE_ASSERT(!s_schema_name.empty(), "TypedDB schema is not registered before creating DB={}", name);
+    }
+
+    // Key/value sizes are validated by the schema loader before constructing
+    TypedDB(DBFamily* db_family, const homestore::superblk< db_super_blk >& sb) : DB(db_family, sb) {
+        DEBUG_ASSERT_EQ(sb->key_size, sizeof(KeyT), "DB={} schema={} key size mismatch", name_, sb->schema_name);
+        DEBUG_ASSERT_EQ(sb->value_size, sizeof(ValueT), "DB={} schema={} value size mismatch", name_,
+                        sb->schema_name);
+    }
+
+    // Has to be called before HomeDB is initialized, so that the DBs of this schema are recovered as TypedDB. A type
+    // is registered under one schema name only, and a schema name only by one type.
+    static void register_schema(const std::string& schema_name) {
+        RELEASE_ASSERT(!schema_name.empty(), "Schema name cannot be empty");
+        RELEASE_ASSERT_LT(schema_name.size(), db_super_blk::MAX_SCHEMA_NAME_LEN, "Schema name too long");
+        RELEASE_ASSERT(s_schema_name.empty() || (s_schema_name == schema_name),
+                       "TypedDB type is already registered as schema={}, cannot register it again as schema={}",
+                       s_schema_name, schema_name);
+        register_db_schema(
+            schema_name, std::type_index{typeid(TypedDB)},
+            [](DBFamily* db_family, const homestore::superblk< db_super_blk >& sb) -> shared< DB > {
+                if ((sb->key_size != sizeof(KeyT)) || (sb->value_size != sizeof(ValueT))) {
+                    LOGERROR("DB={} schema={} has key_size={} value_size={}, but the registered type has key_size={} "
+                             "value_size={}, refusing to load it",
+                             sb->name, sb->schema_name, sb->key_size, sb->value_size, sizeof(KeyT), sizeof(ValueT));
+                    return nullptr;
+                }
+                return std::make_shared< TypedDB >(db_family, sb);
+            });
+        s_schema_name = schema_name;
+    }
+
+    static shared< TypedDB > create(DBFamily& db_family, const std::string& name, const DBOpts& opts) {
+        if (s_schema_name.empty()) {
+            LOGERROR("TypedDB schema is not registered, cannot create DB={}", name);
+            return nullptr;
+        }
+        return to_typed(db_family.create_db(
+                            name, opts,
+                            [](DBFamily* dbf, const std::string& db_name, const DBOpts& db_opts) -> shared< DB > {
+                                return std::make_shared< TypedDB >(dbf, db_name, db_opts);
+                            }),
+                        name);
+    }
+
+    static shared< TypedDB > open(DBFamily& db_family, const std::string& name, const DBOpts& opts) {
+        return to_typed(db_family.open_db(name, opts), name);
+    }
+
+    // Typed ops go through the same DB, family and HomeDB admission stages as DBFamily put/get. A non-zero timeout
+    // overrides the op_timeout of the admission options.
+    folly::Future< Result > put(put_type_t ptype, KeyT const& key, ValueT const& value,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds{0}) {
+        auto self = shared_from_this();
+        return db_family_->admit(self, timeout).thenValue([this, self, ptype, key, value](bool admitted) {
+            if (!admitted) { return folly::makeFuture(Result{Result::Status::timeout, 0}); }
+            return index_put(ptype, key, value).ensure([this, self]() { db_family_->release(self); });
+        });
+    }
+
+    folly::Future< Result > get(KeyT const& key, ValueT& out_value,
+                                std::chrono::milliseconds timeout = std::chrono::milliseconds{0}) {
+        auto self = shared_from_this();
+        return db_family_->admit(self, timeout).thenValue([this, self, key, &out_value](bool admitted) {
+            if (!admitted) { return folly::makeFuture(Result{Result::Status::timeout, 0}); }
+            return index_get(key, out_value).ensure([this, self]() { db_family_->release(self); });
+        });
+    }
+
+    // Blob based access, used by DBFamily put/get which has already admitted the op. Blobs are expected to be exactly
+    // the size of the key/value types.
+    folly::Future< Result > put(put_type_t ptype, sisl::blob const& key, sisl::blob const& value) override {
+        if ((key.size != sizeof(KeyT)) || (value.size != sizeof(ValueT))) {
+            LOGERROR("TypedDB={} put with key size={} value size={}, expected key size={} value size={}", name_,
+                     key.size, value.size, sizeof(KeyT), sizeof(ValueT));
+            return folly::makeFuture(Result{Result::Status::failed, 0});
+        }
+        return index_put(ptype, key_type{key, false /* copy */}.key(), value_type{value, false /* copy */}.value());
+    }
+
+    folly::Future< Result > get(sisl::blob const& key, sisl::blob& out_value) override {
+        if ((key.size != sizeof(KeyT)) || (out_value.size < sizeof(ValueT))) {
+            LOGERROR("TypedDB={} get with key size={} out value size={}, expected key size={} value size={}", name_,
+                     key.size, out_value.size, sizeof(KeyT), sizeof(ValueT));
+            return folly::makeFuture(Result{Result::Status::failed, 0});
+        }
+        auto value = std::make_shared< ValueT >();
+        return index_get(key_type{key, false /* copy */}.key(), *value).thenValue([value, &out_value](Result res) {
+            if (res.status == Result::Status::success) {
+                std::memcpy(out_value.bytes, value.get(), sizeof(ValueT));
+                out_value.size = sizeof(ValueT);
+            }
+            return res;
+        });
+    }
+
+    shared< homestore::IndexTableBase >
+    on_index_found(homestore::superblk< homestore::index_table_sb > const& sb) override {
+        LOGINFO("TypedDB={} uuid={} found an index={}", name_, uuid_, sb->uuid);
+        auto* dbi_sb = r_cast< db_index_super_blk* >(sb->user_sb_bytes);
+
+        if (dbi_sb->index_ordinal == 0) {
+            typed_index_ = std::make_shared< index_type >(sb, index_config());
+        } else {
+            DEBUG_ASSERT(false, "Yet to support secondary index");
+        }
+        return typed_index_;
+    }
+
+protected:
+    void create_primary_index() override {
+        typed_index_ = std::make_shared< index_type >(boost::uuids::random_generator()(), uuid_,
+                                                      sizeof(db_index_super_blk), index_config());
+        auto sb = typed_index_->mutable_super_blk();
+        auto* dbi_sb = r_cast< db_index_super_blk* >(sb->user_sb_bytes);
+        dbi_sb->index_ordinal = 0;
+        sb.write();
+    }
+
+    bool has_primary_index() const override { return (typed_index_ != nullptr); }
+
+private:
+    folly::Future< Result > index_put(put_type_t ptype, KeyT const& key, ValueT const& value) {
+        if (!is_op_supported()) { return folly::makeFuture(Result{Result::Status::not_supported, 0}); }
+
+        auto req = std::make_shared< PutRequest >(key, value, to_btree_put_type(ptype));
+        return typed_index_->async_put(std::dynamic_pointer_cast< homestore::BtreeSinglePutRequest >(req))
+            .thenValue([req](homestore::btree_status_t status) { return Result{to_db_status(status), 0}; });
+    }
+
+    folly::Future< Result > index_get(KeyT const& key, ValueT& out_value) {
+        if (!is_op_supported()) { return folly::makeFuture(Result{Result::Status::not_supported, 0}); }
+
+        auto req = std::make_shared< GetRequest >(key);
+        return typed_index_->async_get(std::dynamic_pointer_cast< homestore::BtreeSingleGetRequest >(req))
+            .thenValue([req, &out_value](homestore::btree_status_t status) {
+                if (status == homestore::btree_status_t::success) { out_value = req->m_value.value(); }
+                return Result{to_db_status(status), 0};
+            });
+    }
+
+    homestore::BtreeConfig index_config() const {
+        homestore::BtreeConfig cfg{homestore::index_service().node_size(), name_ + "_primary"};
+        cfg.m_leaf_node_type = homestore::btree_node_type::FIXED;
+        cfg.m_int_node_type = homestore::btree_node_type::FIXED;
+        return cfg;
+    }
+
+    static shared< TypedDB > to_typed(cshared< DB >& db, const std::string& name) {
+        if (db == nullptr) { return nullptr; }
+        auto typed_db = std::dynamic_pointer_cast< TypedDB >(db);
+        if (typed_db == nullptr) {
+            LOGERROR("DB={} exists, but is not of the typed schema={}", name, s_schema_name);
+            DEBUG_ASSERT(false, "DB schema mismatch");
+        }
+        return typed_db;
+    }
+
+private:
+    static inline std::string s_schema_name;
+    shared< index_type > typed_index_;
+};
+} // namespace homedb
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstring>
+#include <functional>
+#include <type_traits>
+#include <homestore/btree/btree_kv.hpp>
+
+namespace homedb {
+// Fixed size counterparts of DBKey/DBValue for TypedDB. The key/value is held inline (no heap blob) and the classes
+// are final, so that the btree nodes instantiated on them can devirtualize and inline compare/serialize.
+template < typename KeyT, typename Compare = std::less< KeyT > >
+class FixedDBKey final : public homestore::BtreeKey {
+    static_assert(std::is_trivially_copyable_v< KeyT >, "TypedDB key has to be trivially copyable");
+
+public:
+    FixedDBKey() = default;
+    FixedDBKey(KeyT const& key) : key_{key} {}
+    FixedDBKey(FixedDBKey const& other) = default;
+    FixedDBKey(BtreeKey const& other) : FixedDBKey(other.serialize(), true) {}
+    FixedDBKey(sisl::blob const& b, bool copy) : BtreeKey() { deserialize(b, copy); }
+    ~FixedDBKey() override = default;
+
+    static constexpr int compare_keys(KeyT const& k1, KeyT const& k2) {
+        if (Compare{}(k1, k2)) {
+            return -1;
+        } else if (Compare{}(k2, k1)) {
+            return 1;
+        } else {
+            return 0;
+        }
+    }
+
+    void clone(const BtreeKey& other) override { deserialize(other.serialize(), true); }
+    int compare(const BtreeKey& o) const override { return compare_keys(key_, s_cast< const FixedDBKey& >(o).key_); }
+    int compare(const FixedDBKey& o) const { return compare_keys(key_, o.key_); }
+
+    sisl::blob serialize() const override { return sisl::blob{uintptr_cast(const_cast< KeyT* >(&key_)), sizeof(KeyT)}; }
+    uint32_t serialized_size() const override { return sizeof(KeyT); }
+    void deserialize(const sisl::blob& b, bool copy) override {
+        if (b.size != sizeof(KeyT)) {
+            DEBUG_ASSERT_EQ(b.size, sizeof(KeyT), "Typed key size mismatch");
+            key_ = KeyT{};
+            return;
+        }
+        std::memcpy(&key_, b.bytes, sizeof(KeyT));
+    }
+
+    static uint32_t get_fixed_size() { return sizeof(KeyT); }
+    static uint32_t get_estimate_max_size() { return sizeof(KeyT); }
+    static bool is_fixed_size() { return true; }
+
+    std::string to_string() const override { return fmt::format("typed_key size={}", sizeof(KeyT)); }
+    KeyT const& key() const { return key_; }
+
+private:
+    KeyT key_{};
+};
+
+template < typename ValueT >
+class FixedDBValue final : public homestore::BtreeValue {
+    static_assert(std::is_trivially_copyable_v< ValueT >, "TypedDB value has to be trivially copyable");
+
+public:
+    FixedDBValue() = default;
+    FixedDBValue(ValueT const& value) : value_{value} {}
+    FixedDBValue(FixedDBValue const& other) = default;
+    FixedDBValue(const sisl::blob& b, bool copy) : homestore::BtreeValue() { deserialize(b, copy); }
+    ~FixedDBValue() override = default;
+
+    sisl::blob serialize() const override {
+        return sisl::blob{uintptr_cast(const_cast< ValueT* >(&value_)), sizeof(ValueT)};
+    }
+    uint32_t serialized_size() const override { return sizeof(ValueT); }
+    void deserialize(const sisl::blob& b, bool copy) override {
+        if (b.size != sizeof(ValueT)) {
+            DEBUG_ASSERT_EQ(b.size, sizeof(ValueT), "Typed value size mismatch");
+            value_ = ValueT{};
+            return;
+        }
+        std::memcpy(&value_, b.bytes, sizeof(ValueT));
+    }
+
+    static uint32_t get_fixed_size() { return sizeof(ValueT); }
+
+    std::string to_string() const override { return fmt::format("typed_value size={}", sizeof(ValueT)); }
+    ValueT const& value() const { return value_; }
+
+private:
+    ValueT value_{};
+};
+} // namespace homedb